@@ -0,0 +1,394 @@
+#ifndef MAGMA_EVAL_HPP
+#define MAGMA_EVAL_HPP
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#ifdef __AVX2__
+# include <immintrin.h>
+#endif
+
+/**
+ * Evaluation of equations on a concrete Cayley table.
+ *
+ * A table of order `n` is given row-major, that is, $xy$ is `table[x * n + y]`.
+ * Every entry must be smaller than `n`.
+ * The entries may be of type `std::uint8_t` or `std::uint16_t`.
+ *
+ * If the code is compiled with AVX2 enabled (e.g. `-mavx2` or `-march=native`),
+ * tables of order at most 5 are kept in registers and all pairs are checked at once.
+ * The kernels which check eight lanes at a time using gathers are used for larger tables
+ * only if `MAGMA_EVAL_GATHER` is also defined, since they may be slower than the scalar loops.
+ * `eval_test bench` measures all the paths on the host.
+ * Otherwise, the scalar loops are used.
+ */
+
+namespace magma {
+    namespace detail {
+        template <typename T>
+        inline void check_table_type() {
+            static_assert(
+              std::is_same<T, std::uint8_t>::value || std::is_same<T, std::uint16_t>::value,
+              "Entries of the table must be std::uint8_t or std::uint16_t.");
+        }
+
+        /** Equation 677 is $x = y(x((yx)y))$. */
+        template <typename T>
+        inline bool holds677_scalar(T const *table, ssize const n) {
+            for(ssize x = 0; x < n; x++) {
+                for(ssize y = 0; y < n; y++) {
+                    ssize const a = table[y * n + x];
+                    ssize const b = table[a * n + y];
+                    ssize const c = table[x * n + b];
+                    if(table[y * n + c] != x) { return false; }
+                }
+            }
+            return true;
+        }
+
+        /** Equation 2504 is $x = (y((xy)x))y$. */
+        template <typename T>
+        inline bool holds2504_scalar(T const *table, ssize const n) {
+            for(ssize x = 0; x < n; x++) {
+                for(ssize y = 0; y < n; y++) {
+                    ssize const a = table[x * n + y];
+                    ssize const b = table[a * n + x];
+                    ssize const c = table[y * n + b];
+                    if(table[c * n + y] != x) { return false; }
+                }
+            }
+            return true;
+        }
+
+        /** Equation 255 is $x = ((xx)x)x$. */
+        template <typename T>
+        inline bool holds255_scalar(T const *table, ssize const n) {
+            for(ssize x = 0; x < n; x++) {
+                ssize const a = table[x * n + x];
+                ssize const b = table[a * n + x];
+                if(table[b * n + x] != x) { return false; }
+            }
+            return true;
+        }
+
+#ifdef __AVX2__
+        /**
+         * The vectorized kernels index the table with 32-bit lanes,
+         * so larger tables are left to the scalar loops. */
+        constexpr ssize simd_max_n = 46'340;
+
+        /**
+         * A gather reads four bytes per lane, which may run past the end of the table.
+         * Hence, the entry at `i` is read as the last `sizeof(T)` bytes of the four bytes ending
+         * there, and the first few entries, which have no such four bytes, are taken from `head`.
+         */
+        template <typename T>
+        struct simd_table {
+            static constexpr int lead = 4 / sizeof(T) - 1;
+            static constexpr int shift = 32 - 8 * sizeof(T);
+
+            T const *table;
+            __m256i head;
+            __m256i nv;
+
+            simd_table(T const *table, ssize const n) : table(table) {
+                int first[3] = {};
+                for(ssize i = 0; i < lead && i < n * n; i++) { first[i] = table[i] << shift; }
+                head = _mm256_setr_epi32(first[0], first[1], first[2], 0, 0, 0, 0, 0);
+                nv = _mm256_set1_epi32(static_cast<int>(n));
+            }
+
+            /** `at(i)` is `table[i]` for each lane of `i`. */
+            __m256i at(__m256i const i) const {
+                __m256i const inside = _mm256_cmpgt_epi32(i, _mm256_set1_epi32(lead - 1));
+                __m256i const v = _mm256_mask_i32gather_epi32(
+                  _mm256_permutevar8x32_epi32(head, i),
+                  reinterpret_cast<int const *>(table),
+                  _mm256_sub_epi32(i, _mm256_set1_epi32(lead)),
+                  inside,
+                  sizeof(T));
+                return _mm256_srli_epi32(v, shift);
+            }
+
+            /** `mul(x, y)` is $xy$ for each lane. */
+            __m256i mul(__m256i const x, __m256i const y) const {
+                return at(_mm256_add_epi32(_mm256_mullo_epi32(x, nv), y));
+            }
+        };
+
+        /**
+         * `lanes(base, n)` is `base + i` for the `i`-th lane.
+         * Lanes past `n - 1` are clamped to `n - 1`, which only repeats a valid check. */
+        inline __m256i lanes(ssize const base, ssize const n) {
+            return _mm256_min_epi32(
+              _mm256_add_epi32(
+                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                _mm256_set1_epi32(static_cast<int>(base))),
+              _mm256_set1_epi32(static_cast<int>(n - 1)));
+        }
+
+        inline bool all_equal(__m256i const a, __m256i const b) {
+            return _mm256_movemask_epi8(_mm256_cmpeq_epi32(a, b)) == -1;
+        }
+
+        /** For a fixed $x$, all $y$ are checked eight at a time. */
+        template <typename T>
+        inline bool holds677_avx2(T const *table, ssize const n) {
+            simd_table<T> const t(table, n);
+            for(ssize x = 0; x < n; x++) {
+                __m256i const xv = _mm256_set1_epi32(static_cast<int>(x));
+                for(ssize y0 = 0; y0 < n; y0 += 8) {
+                    __m256i const yv = lanes(y0, n);
+                    __m256i const d = t.mul(yv, t.mul(xv, t.mul(t.mul(yv, xv), yv)));
+                    if(!all_equal(d, xv)) { return false; }
+                }
+            }
+            return true;
+        }
+
+        /** For a fixed $x$, all $y$ are checked eight at a time. */
+        template <typename T>
+        inline bool holds2504_avx2(T const *table, ssize const n) {
+            simd_table<T> const t(table, n);
+            for(ssize x = 0; x < n; x++) {
+                __m256i const xv = _mm256_set1_epi32(static_cast<int>(x));
+                for(ssize y0 = 0; y0 < n; y0 += 8) {
+                    __m256i const yv = lanes(y0, n);
+                    __m256i const d = t.mul(t.mul(yv, t.mul(t.mul(xv, yv), xv)), yv);
+                    if(!all_equal(d, xv)) { return false; }
+                }
+            }
+            return true;
+        }
+
+        /** Equation 255 has a single variable, so $x$ is checked eight at a time. */
+        template <typename T>
+        inline bool holds255_avx2(T const *table, ssize const n) {
+            simd_table<T> const t(table, n);
+            for(ssize x0 = 0; x0 < n; x0 += 8) {
+                __m256i const xv = lanes(x0, n);
+                __m256i const d = t.mul(t.mul(t.mul(xv, xv), xv), xv);
+                if(!all_equal(d, xv)) { return false; }
+            }
+            return true;
+        }
+
+        /** The largest order whose table fits in the 32 bytes of `small_table`. */
+        constexpr ssize small_max_n = 5;
+
+        /** `x[p]` and `y[p]` are $x$ and $y$ of the `p`-th pair $(x, y)$ in row-major order. */
+        struct pair_lanes {
+            std::uint8_t x[32];
+            std::uint8_t y[32];
+        };
+
+        constexpr pair_lanes make_pair_lanes(ssize const n) {
+            pair_lanes lanes {};
+            for(ssize p = 0; p < n * n; p++) {
+                lanes.x[p] = static_cast<std::uint8_t>(p / n);
+                lanes.y[p] = static_cast<std::uint8_t>(p % n);
+            }
+            return lanes;
+        }
+
+        /**
+         * `load_small(table, n, lo, hi)` loads the $n^2$ entries into 32 bytes `lo` and `hi`.
+         * It never reads past the end of the table, and reads nothing if $n$ is not in $[1, 5]$.
+         * Bytes past the last entry are unspecified, since they are never looked up. */
+        inline void load_small(std::uint8_t const *t, ssize const n, __m128i &lo, __m128i &hi) {
+            hi = _mm_setzero_si128();
+            switch(n) {
+            case 1: lo = _mm_cvtsi32_si128(t[0]); break;
+            case 2: {
+                int v;
+                std::memcpy(&v, t, sizeof(v));
+                lo = _mm_cvtsi32_si128(v);
+                break;
+            }
+            case 3:
+                lo = _mm_insert_epi8(
+                  _mm_loadl_epi64(reinterpret_cast<__m128i const *>(t)), t[8], 8);
+                break;
+            case 4: lo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(t)); break;
+            case 5:
+                lo = _mm_loadu_si128(reinterpret_cast<__m128i const *>(t));
+                hi = _mm_srli_si128(_mm_loadu_si128(reinterpret_cast<__m128i const *>(t + 9)), 7);
+                break;
+            default: lo = _mm_setzero_si128(); break;
+            }
+        }
+
+        inline void load_small(std::uint16_t const *t, ssize const n, __m128i &lo, __m128i &hi) {
+            __m128i const zero = _mm_setzero_si128();
+            hi = zero;
+            switch(n) {
+            case 1: lo = _mm_cvtsi32_si128(t[0]); break;
+            case 2:
+                lo = _mm_packus_epi16(_mm_loadl_epi64(reinterpret_cast<__m128i const *>(t)), zero);
+                break;
+            case 3:
+                lo = _mm_packus_epi16(
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t)), _mm_cvtsi32_si128(t[8]));
+                break;
+            case 4:
+                lo = _mm_packus_epi16(
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t)),
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t + 8)));
+                break;
+            case 5:
+                lo = _mm_packus_epi16(
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t)),
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t + 8)));
+                hi = _mm_packus_epi16(
+                  _mm_loadu_si128(reinterpret_cast<__m128i const *>(t + 16)),
+                  _mm_cvtsi32_si128(t[24]));
+                break;
+            default: lo = zero; break;
+            }
+        }
+
+        /**
+         * A table of order at most `small_max_n`, kept in registers as bytes.
+         * All $n^2$ pairs are evaluated at once, one pair per byte lane,
+         * and each lookup is a pair of `vpshufb` instead of a gather. */
+        struct small_table {
+            __m256i lo;
+            __m256i hi;
+            __m256i nv;
+            __m256i x;
+            __m256i y;
+            __m256i invalid;
+
+            template <typename T>
+            small_table(T const *table, ssize const n) {
+                static constexpr pair_lanes all_lanes[small_max_n + 1] = {
+                  make_pair_lanes(0),
+                  make_pair_lanes(1),
+                  make_pair_lanes(2),
+                  make_pair_lanes(3),
+                  make_pair_lanes(4),
+                  make_pair_lanes(5)};
+
+                __m128i lo_bytes;
+                __m128i hi_bytes;
+                load_small(table, n, lo_bytes, hi_bytes);
+                lo = _mm256_broadcastsi128_si256(lo_bytes);
+                hi = _mm256_broadcastsi128_si256(hi_bytes);
+                nv = _mm256_set1_epi16(static_cast<short>(n));
+                x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(all_lanes[n].x));
+                y = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(all_lanes[n].y));
+                invalid = _mm256_cmpgt_epi8(
+                  _mm256_setr_epi8(
+                    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31),
+                  _mm256_set1_epi8(static_cast<char>(n * n - 1)));
+            }
+
+            /**
+             * `at(i)` is `table[i]` for each byte lane of `i`.
+             * Bit 4 of `i`, shifted up to bit 7, chooses between the two halves of the table. */
+            __m256i at(__m256i const i) const {
+                return _mm256_blendv_epi8(
+                  _mm256_shuffle_epi8(lo, i), _mm256_shuffle_epi8(hi, i), _mm256_slli_epi16(i, 3));
+            }
+
+            /**
+             * `mul(x, y)` is $xy$ for each byte lane.
+             * Since $xn < 32$, the 16-bit multiplication never carries into the next byte. */
+            __m256i mul(__m256i const x, __m256i const y) const {
+                return at(_mm256_add_epi8(_mm256_mullo_epi16(x, nv), y));
+            }
+
+            /** Lanes past the last pair are ignored. */
+            bool all_equal(__m256i const a, __m256i const b) const {
+                __m256i const equal = _mm256_cmpeq_epi8(a, b);
+                return _mm256_movemask_epi8(_mm256_or_si256(equal, invalid)) == -1;
+            }
+        };
+
+        template <typename T>
+        inline bool holds677_small(T const *table, ssize const n) {
+            small_table const t(table, n);
+            return t.all_equal(t.mul(t.y, t.mul(t.x, t.mul(t.mul(t.y, t.x), t.y))), t.x);
+        }
+
+        template <typename T>
+        inline bool holds2504_small(T const *table, ssize const n) {
+            small_table const t(table, n);
+            return t.all_equal(t.mul(t.mul(t.y, t.mul(t.mul(t.x, t.y), t.x)), t.y), t.x);
+        }
+
+        /** Every $x$ appears among the pairs, so the pairs are reused for equation 255. */
+        template <typename T>
+        inline bool holds255_small(T const *table, ssize const n) {
+            small_table const t(table, n);
+            return t.all_equal(t.mul(t.mul(t.mul(t.x, t.x), t.x), t.x), t.x);
+        }
+#endif
+    }  // namespace detail
+
+    /**
+     * For $n \leq 5$, the register kernel is always used.
+     * It does not exit early, but it was never much slower than the scalar loops there,
+     * and much faster on tables which satisfy the equation.
+     * The gather kernels measured slower than the scalar loops at every order,
+     * so they are used only if `MAGMA_EVAL_GATHER` is defined.
+     * `eval_test bench` measures all the paths on the host.
+     */
+
+    /**
+     * This function checks if all elements of the magma satisfy 677.
+     * @param table The Cayley table in row-major order.
+     * @param n The number of elements in the magma.
+     */
+    template <typename T>
+    inline bool holds677(T const *table, ssize const n) {
+        detail::check_table_type<T>();
+#ifdef __AVX2__
+        if(0 < n && n <= detail::small_max_n) { return detail::holds677_small(table, n); }
+# ifdef MAGMA_EVAL_GATHER
+        if(n <= detail::simd_max_n) { return detail::holds677_avx2(table, n); }
+# endif
+#endif
+        return detail::holds677_scalar(table, n);
+    }
+
+    /**
+     * This function checks if all elements of the magma satisfy 2504.
+     * @param table The Cayley table in row-major order.
+     * @param n The number of elements in the magma.
+     */
+    template <typename T>
+    inline bool holds2504(T const *table, ssize const n) {
+        detail::check_table_type<T>();
+#ifdef __AVX2__
+        if(0 < n && n <= detail::small_max_n) { return detail::holds2504_small(table, n); }
+# ifdef MAGMA_EVAL_GATHER
+        if(n <= detail::simd_max_n) { return detail::holds2504_avx2(table, n); }
+# endif
+#endif
+        return detail::holds2504_scalar(table, n);
+    }
+
+    /**
+     * This function checks if all elements of the magma satisfy 255.
+     * @param table The Cayley table in row-major order.
+     * @param n The number of elements in the magma.
+     */
+    template <typename T>
+    inline bool holds255(T const *table, ssize const n) {
+        detail::check_table_type<T>();
+#ifdef __AVX2__
+        if(0 < n && n <= detail::small_max_n) { return detail::holds255_small(table, n); }
+# ifdef MAGMA_EVAL_GATHER
+        if(n <= detail::simd_max_n) { return detail::holds255_avx2(table, n); }
+# endif
+#endif
+        return detail::holds255_scalar(table, n);
+    }
+}  // namespace magma
+
+#endif  // MAGMA_EVAL_HPP
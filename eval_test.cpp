@@ -0,0 +1,215 @@
+#include "eval.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * This program compares the vectorized kernels of `eval.hpp` against the scalar loops.
+ * With the argument `bench`, it also reports how many tables per second each path checks.
+ *
+ * It must be compiled with AVX2 enabled to test anything beyond the scalar loops.
+ */
+
+namespace {
+    using magma::ssize;
+
+    template <typename T>
+    using kernel = bool (*)(T const *, ssize);
+
+    template <typename T>
+    struct equation {
+        char const *name;
+        kernel<T> scalar;
+        kernel<T> dispatch;
+#ifdef __AVX2__
+        kernel<T> gather;
+        kernel<T> small;
+#endif
+    };
+
+    template <typename T>
+    std::vector<equation<T>> equations() {
+        using namespace magma;
+        return {
+          {"677",
+           detail::holds677_scalar<T>,
+           holds677<T>,
+#ifdef __AVX2__
+           detail::holds677_avx2<T>,
+           detail::holds677_small<T>
+#endif
+          },
+          {"2504",
+           detail::holds2504_scalar<T>,
+           holds2504<T>,
+#ifdef __AVX2__
+           detail::holds2504_avx2<T>,
+           detail::holds2504_small<T>
+#endif
+          },
+          {"255",
+           detail::holds255_scalar<T>,
+           holds255<T>,
+#ifdef __AVX2__
+           detail::holds255_avx2<T>,
+           detail::holds255_small<T>
+#endif
+          }};
+    }
+
+    /** `affine(n, a, b, c)` is the table of $xy = ax + by + c$ modulo $n$. */
+    template <typename T>
+    std::vector<T> affine(ssize const n, ssize const a, ssize const b, ssize const c) {
+        std::vector<T> table(n * n);
+        for(ssize x = 0; x < n; x++) {
+            for(ssize y = 0; y < n; y++) {
+                table[x * n + y] = static_cast<T>((a * x + b * y + c) % n);
+            }
+        }
+        return table;
+    }
+
+    struct counter {
+        ssize tables = 0;
+        ssize mismatches = 0;
+        ssize satisfied[3] = {};
+    };
+
+    /** Every path must agree with the scalar loop on `table`. */
+    template <typename T>
+    void compare(std::vector<T> const &table, ssize const n, counter &count) {
+        auto const eqs = equations<T>();
+        count.tables++;
+        for(std::size_t k = 0; k < eqs.size(); k++) {
+            auto const &eq = eqs[k];
+            bool const expected = eq.scalar(table.data(), n);
+            count.satisfied[k] += expected;
+
+            std::vector<std::pair<char const *, bool>> results = {
+              {"dispatch", eq.dispatch(table.data(), n)}};
+#ifdef __AVX2__
+            results.push_back({"gather", eq.gather(table.data(), n)});
+            if(n <= magma::detail::small_max_n) {
+                results.push_back({"small", eq.small(table.data(), n)});
+            }
+#endif
+            for(auto const &result: results) {
+                if(result.second == expected) { continue; }
+                count.mismatches++;
+                std::cerr << "Mismatch: equation " << eq.name << ", " << result.first << ", "
+                          << sizeof(T) * 8 << "-bit, n = " << n << ", table =";
+                for(auto const e: table) { std::cerr << ' ' << e + 0; }
+                std::cerr << std::endl;
+            }
+        }
+    }
+
+    template <typename T>
+    void check(counter &count) {
+        std::mt19937 rng(677);
+
+        /** All tables of order at most 3, including the empty magma. */
+        for(ssize n = 0; n <= 3; n++) {
+            std::vector<T> table(n * n);
+            while(true) {
+                compare(table, n, count);
+                ssize i = 0;
+                for(; i < n * n && table[i] == n - 1; i++) { table[i] = 0; }
+                if(i == n * n) { break; }
+                table[i]++;
+            }
+        }
+
+        /** Affine tables, and the same tables with some entries changed. */
+        for(ssize n = 1; n <= 40; n++) {
+            for(ssize a = 0; a < n; a++) {
+                for(ssize b = 0; b < n; b++) {
+                    for(ssize c = 0; c < 2 && c < n; c++) {
+                        auto table = affine<T>(n, a, b, c);
+                        compare(table, n, count);
+                        for(int changes = 1; changes <= 2; changes++) {
+                            auto changed = table;
+                            for(int i = 0; i < changes; i++) {
+                                changed[rng() % (n * n)] = static_cast<T>(rng() % n);
+                            }
+                            compare(changed, n, count);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /** Tables per second of `f` on `table`, in millions, measured over at least 50 ms. */
+    template <typename T>
+    double rate(kernel<T> const f, std::vector<T> const &table, ssize const n) {
+        ssize rounds = 0;
+        ssize sink = 0;
+        auto const begin = std::chrono::steady_clock::now();
+        std::chrono::duration<double> elapsed {};
+        while(elapsed.count() < 0.05) {
+            for(ssize i = 0; i < 1'000; i++) {
+                T const *volatile data = table.data();
+                sink += f(data, n);
+            }
+            rounds += 1'000;
+            elapsed = std::chrono::steady_clock::now() - begin;
+        }
+        if(sink < 0) { std::cout << sink; }
+        return rounds / elapsed.count() / 1e6;
+    }
+
+    /**
+     * For each order, the 677 kernels are timed on an affine model of 677 if there is one,
+     * where every pair has to be checked, and on an affine table which is rejected early. */
+    void bench() {
+        using T = std::uint8_t;
+        auto const eq = equations<T>()[0];
+        std::cout << "M tables/s of 677 with 8-bit entries\n";
+        for(ssize const n: {2, 3, 4, 5, 6, 7, 8, 11, 13, 16, 17, 19, 23, 29, 31, 37, 64}) {
+            std::vector<T> model;
+            for(ssize a = 0; a < n && model.empty(); a++) {
+                for(ssize b = 0; b < n && model.empty(); b++) {
+                    auto table = affine<T>(n, a, b, 0);
+                    if(eq.scalar(table.data(), n)) { model = std::move(table); }
+                }
+            }
+            std::vector<std::pair<char const *, std::vector<T>>> tables = {
+              {"rejected", affine<T>(n, 1, 1, 0)}};
+            if(!model.empty()) { tables.insert(tables.begin(), {"model", model}); }
+
+            for(auto const &table: tables) {
+                std::cout << "n = " << n << ", " << table.first << ":";
+                std::cout << " scalar " << rate(eq.scalar, table.second, n);
+#ifdef __AVX2__
+                std::cout << ", gather " << rate(eq.gather, table.second, n);
+                if(n <= magma::detail::small_max_n) {
+                    std::cout << ", small " << rate(eq.small, table.second, n);
+                }
+#endif
+                std::cout << ", dispatch " << rate(eq.dispatch, table.second, n) << '\n';
+            }
+        }
+    }
+}  // namespace
+
+int main(int argc, char *argv[]) {
+#ifndef __AVX2__
+    std::cerr << "AVX2 is not enabled; only the scalar loops are tested." << std::endl;
+#endif
+
+    counter count;
+    check<std::uint8_t>(count);
+    check<std::uint16_t>(count);
+    std::cout << count.tables << " tables, " << count.mismatches << " mismatches\n";
+    std::cout << "Satisfied: 677 " << count.satisfied[0] << ", 2504 " << count.satisfied[1]
+              << ", 255 " << count.satisfied[2] << '\n';
+
+    if(argc == 2 && std::string(argv[1]) == "bench") { bench(); }
+
+    return count.mismatches == 0 ? 0 : 1;
+}